@@ -1,2 +1,3 @@
 #!/bin/sh
-gcc -o CardGen main.c -I/usr/include/freetype2/ -lm -lpng -lfreetype
+# For smaller --optimize output, add -DUSE_LIBDEFLATE -ldeflate and/or -DUSE_ZOPFLI -lzopfli
+gcc -o CardGen main.c -I/usr/include/freetype2/ -lm -lpng -lz -lpthread -lfreetype
@@ -2,8 +2,19 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <png.h>
+#include <zlib.h>
+
+#ifdef USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#ifdef USE_ZOPFLI
+#include <zopfli.h>
+#endif
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -31,6 +42,12 @@
 
 #define GLYPH_CENTRE 0xffffffff
 
+/* Rendered glyphs are kept for reuse, keyed by face, size and character */
+#define GLYPH_CACHE_SIZE 128
+
+/* Most pips on a card, not counting mirrors */
+#define PIPS_MAX 3
+
 
 typedef struct Colour_t {
     uint8_t r;
@@ -51,6 +68,43 @@ typedef struct image_t {
     uint32_t height;
 } Image;
 
+typedef struct glyph_t {
+    FT_Face face;
+    uint32_t point;
+    uint32_t c;
+    uint8_t *bitmap;            /* Coverage, width × rows with no padding */
+    uint32_t width;
+    uint32_t rows;
+    int32_t top;                /* Distance from the baseline to the top of the bitmap */
+    uint32_t advance;
+} Glyph;
+
+/* Where a suit symbol goes on a card. x and y may be GLYPH_CENTRE. */
+typedef struct pip_t {
+    uint32_t x;
+    uint32_t y;
+    uint32_t point;
+    uint32_t mirror;
+} Pip;
+
+typedef struct pip_layout_t {
+    uint32_t count;
+    Pip pips[PIPS_MAX];
+} PipLayout;
+
+/* A pip with its glyph loaded and position resolved, ready to draw */
+typedef struct draw_command_t {
+    const Glyph *glyph;
+    uint32_t x;
+    uint32_t y;
+    uint32_t mirror;
+} DrawCommand;
+
+typedef struct draw_list_t {
+    uint32_t count;
+    DrawCommand commands[PIPS_MAX];
+} DrawList;
+
 static const Colour COLOUR_WHITE        = {255, 255, 255};
 static const Colour COLOUR_BLACK        = {  0,   0,   0};
 static const Colour COLOUR_RED          = {255,   0,   0};
@@ -67,6 +121,39 @@ static FT_Face ft_face_symbol;
 static const char *card_values[] = {"A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K"};
 static const uint32_t card_suits[]  = {0x2665 /* ♥ */, 0x2666 /* ♦ */, 0x2663 /* ♣ */, 0x2660 /* ♠*/};
 static Colour card_colours[4] = {};
+static Glyph glyph_cache[GLYPH_CACHE_SIZE];
+static uint32_t glyph_cache_count;
+
+/* Body of each card, indexed the same as card_values */
+static const PipLayout pip_layouts[] = {
+    /* A */  { 1, { { GLYPH_CENTRE, GLYPH_CENTRE,       ACE_SUIT_POINT,     MIRROR_NONE } } },
+    /* 2 */  { 1, { { GLYPH_CENTRE, BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN } } },
+    /* 3 */  { 2, { { GLYPH_CENTRE, BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN },
+                    { GLYPH_CENTRE, GLYPH_CENTRE,       REGULAR_SUIT_POINT, MIRROR_NONE } } },
+    /* 4 */  { 1, { { BODY_LEFT,    BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG } } },
+    /* 5 */  { 2, { { BODY_LEFT,    BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG },
+                    { GLYPH_CENTRE, GLYPH_CENTRE,       REGULAR_SUIT_POINT, MIRROR_NONE } } },
+    /* 6 */  { 2, { { BODY_LEFT,    BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG },
+                    { BODY_LEFT,    GLYPH_CENTRE,       REGULAR_SUIT_POINT, MIRROR_ACROSS } } },
+    /* 7 */  { 3, { { BODY_LEFT,    BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG },
+                    { BODY_LEFT,    GLYPH_CENTRE,       REGULAR_SUIT_POINT, MIRROR_ACROSS },
+                    { GLYPH_CENTRE, BODY_BASELINE + 8,  REGULAR_SUIT_POINT, MIRROR_NONE } } },
+    /* 8 */  { 3, { { BODY_LEFT,    BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG },
+                    { BODY_LEFT,    GLYPH_CENTRE,       REGULAR_SUIT_POINT, MIRROR_ACROSS },
+                    { GLYPH_CENTRE, BODY_BASELINE + 8,  REGULAR_SUIT_POINT, MIRROR_DOWN } } },
+    /* 9 */  { 3, { { BODY_LEFT,    BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG },
+                    { BODY_LEFT,    BODY_BASELINE + 10, REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG },
+                    { GLYPH_CENTRE, GLYPH_CENTRE,       REGULAR_SUIT_POINT, MIRROR_NONE } } },
+    /* 10 */ { 3, { { BODY_LEFT,    BODY_BASELINE,      REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG },
+                    { BODY_LEFT,    BODY_BASELINE + 10, REGULAR_SUIT_POINT, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG },
+                    { GLYPH_CENTRE, BODY_BASELINE + 5,  REGULAR_SUIT_POINT, MIRROR_DOWN } } },
+    /* Picture cards just need a box */
+    /* J */  { 0 },
+    /* Q */  { 0 },
+    /* K */  { 0 },
+};
+_Static_assert (sizeof (pip_layouts) / sizeof (pip_layouts[0]) == sizeof (card_values) / sizeof (card_values[0]),
+                "Each card value needs a pip layout");
 
 
 static Pixel *pixel_get (Image *i, uint32_t x, uint32_t y)
@@ -74,81 +161,685 @@ static Pixel *pixel_get (Image *i, uint32_t x, uint32_t y)
     return &i->data[i->width * y + x];
 }
 
-static int export (Image *i, const char *path)
+/* Filtered PNG rows are split into blocks of about this many bytes, which
+ * are then filtered and deflated on separate threads (as pigz does) */
+#define PNG_BLOCK_SIZE  (128 * 1024)
+#define PNG_WINDOW_SIZE 32768
+
+/* Row filter heuristics. Values below PNG_FILTER_VALUE_LAST use that filter
+ * type for every row, the others choose a filter type for each row. */
+#define PNG_HEURISTIC_MINSUM  (PNG_FILTER_VALUE_LAST + 0)
+#define PNG_HEURISTIC_ENTROPY (PNG_FILTER_VALUE_LAST + 1)
+#define PNG_HEURISTIC_COUNT   (PNG_FILTER_VALUE_LAST + 2)
+
+/* Stands in for a zlib strategy when a candidate is compressed with libdeflate */
+#define PNG_STRATEGY_LIBDEFLATE (-1)
+
+typedef struct work_queue_t {
+    uint32_t count;
+    uint32_t next;
+    pthread_mutex_t lock;
+} WorkQueue;
+
+typedef struct png_block_t {
+    uint32_t first_row;
+    uint32_t rows;
+    uint8_t *deflated;
+    size_t deflated_size;
+    uLong adler;
+    bool failed;
+} PngBlock;
+
+typedef struct png_encoder_t {
+    Image *image;
+    uint8_t *filtered;          /* Filter-type byte followed by filtered pixels, for each row */
+    size_t stride;              /* Bytes per filtered row, including the filter-type byte */
+    uint8_t heuristic;
+    int level;
+    PngBlock *blocks;
+    WorkQueue queue;            /* One job per block */
+} PngEncoder;
+
+typedef struct png_candidate_t {
+    uint8_t heuristic;
+    int level;
+    int strategy;
+} PngCandidate;
+
+typedef struct png_search_t {
+    PngEncoder *encoders;       /* One per heuristic, already filtered */
+    PngCandidate *candidates;
+    WorkQueue queue;            /* One job per candidate */
+    pthread_mutex_t lock;       /* Protects the fields below */
+    uint8_t *best;
+    size_t best_size;
+    uint32_t best_candidate;
+    bool failed;
+} PngSearch;
+
+/* Take the next job from the queue, returning false once all are taken */
+static bool work_queue_take (WorkQueue *q, uint32_t *index)
 {
-    FILE *file = fopen (path, "wb");
+    bool taken = false;
 
-    png_structp png_ptr = NULL;
-    png_infop info_ptr = NULL;
-    uint32_t x, y;
-    png_byte ** row_pointers = NULL;
+    pthread_mutex_lock (&q->lock);
+    if (q->next < q->count)
+    {
+        *index = q->next++;
+        taken = true;
+    }
+    pthread_mutex_unlock (&q->lock);
 
-    int pixel_size = 4;
-    int depth = 8;
+    return taken;
+}
 
-    if (!file)
+/* Run worker on up to one thread per CPU until the queue is empty */
+static void work_queue_run (WorkQueue *q, void *(*worker) (void *), void *arg)
+{
+    long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+    uint32_t thread_count = (cpus < 1) ? 1 : (uint32_t) cpus;
+    uint32_t started = 0;
+
+    if (thread_count > q->count)
     {
-        fprintf (stderr, "Error: Unable to open file %s for writing.\n", path);
+        thread_count = q->count ? q->count : 1;
+    }
+
+    pthread_t threads[thread_count];
+
+    q->next = 0;
+    pthread_mutex_init (&q->lock, NULL);
+
+    /* The calling thread also takes jobs, so one fewer thread is needed */
+    for (uint32_t t = 1; t < thread_count; t++)
+    {
+        if (pthread_create (&threads[started], NULL, worker, arg) == 0)
+        {
+            started++;
+        }
+    }
+
+    worker (arg);
+
+    for (uint32_t t = 0; t < started; t++)
+    {
+        pthread_join (threads[t], NULL);
+    }
+
+    pthread_mutex_destroy (&q->lock);
+}
+
+static uint8_t png_paeth (uint8_t a, uint8_t b, uint8_t c)
+{
+    int p  = a + b - c;
+    int pa = abs (p - a);
+    int pb = abs (p - b);
+    int pc = abs (p - c);
+
+    if (pa <= pb && pa <= pc)
+    {
+        return a;
+    }
+    return (pb <= pc) ? b : c;
+}
+
+/* Apply one PNG filter type to a row. prev is NULL for the first row. */
+static void png_filter_apply (uint8_t *out, const uint8_t *row, const uint8_t *prev, size_t length, uint8_t filter)
+{
+    const size_t bpp = sizeof (Pixel);
+
+    for (size_t x = 0; x < length; x++)
+    {
+        uint8_t a = (x >= bpp) ? row[x - bpp] : 0;
+        uint8_t b = prev ? prev[x] : 0;
+        uint8_t c = (prev && x >= bpp) ? prev[x - bpp] : 0;
+
+        switch (filter)
+        {
+            case PNG_FILTER_VALUE_NONE:  out[x] = row[x];                        break;
+            case PNG_FILTER_VALUE_SUB:   out[x] = row[x] - a;                    break;
+            case PNG_FILTER_VALUE_UP:    out[x] = row[x] - b;                    break;
+            case PNG_FILTER_VALUE_AVG:   out[x] = row[x] - ((a + b) >> 1);       break;
+            case PNG_FILTER_VALUE_PAETH: out[x] = row[x] - png_paeth (a, b, c);  break;
+        }
+    }
+}
+
+/* Score a filtered row for a heuristic, lower is expected to compress better.
+ * MINSUM is the sum of absolute differences that libpng uses by default,
+ * ENTROPY is the Shannon entropy of the row's bytes. */
+static double png_filter_score (const uint8_t *filtered, size_t length, uint8_t heuristic)
+{
+    double score = 0.0;
+
+    if (heuristic == PNG_HEURISTIC_ENTROPY)
+    {
+        uint32_t counts[256] = { 0 };
+
+        for (size_t x = 0; x < length; x++)
+        {
+            counts[filtered[x]]++;
+        }
+        for (uint32_t v = 0; v < 256; v++)
+        {
+            if (counts[v])
+            {
+                score -= counts[v] * log2 ((double) counts[v] / length);
+            }
+        }
+    }
+    else
+    {
+        for (size_t x = 0; x < length; x++)
+        {
+            score += (filtered[x] < 128) ? filtered[x] : 256 - filtered[x];
+        }
+    }
+
+    return score;
+}
+
+/* Filter a row as chosen by the heuristic. out must have room for the
+ * filter-type byte, and scratch for one filtered row. */
+static void png_filter_row (uint8_t *out, uint8_t *scratch, const uint8_t *row, const uint8_t *prev,
+                            size_t length, uint8_t heuristic)
+{
+    double best_score = INFINITY;
+
+    if (heuristic < PNG_FILTER_VALUE_LAST)
+    {
+        out[0] = heuristic;
+        png_filter_apply (&out[1], row, prev, length, heuristic);
+        return;
+    }
+
+    for (uint8_t filter = PNG_FILTER_VALUE_NONE; filter < PNG_FILTER_VALUE_LAST; filter++)
+    {
+        png_filter_apply (scratch, row, prev, length, filter);
+
+        double score = png_filter_score (scratch, length, heuristic);
+        if (score < best_score)
+        {
+            best_score = score;
+            out[0] = filter;
+            memcpy (&out[1], scratch, length);
+        }
+    }
+}
+
+static void *png_filter_worker (void *arg)
+{
+    PngEncoder *e = arg;
+    size_t length = e->stride - 1;
+    uint8_t *scratch = malloc (length);
+    uint32_t index;
+
+    while (work_queue_take (&e->queue, &index))
+    {
+        PngBlock *block = &e->blocks[index];
+
+        if (!scratch)
+        {
+            block->failed = true;
+            continue;
+        }
+
+        for (uint32_t y = block->first_row; y < block->first_row + block->rows; y++)
+        {
+            const uint8_t *row  = (const uint8_t *) pixel_get (e->image, 0, y);
+            const uint8_t *prev = y ? (const uint8_t *) pixel_get (e->image, 0, y - 1) : NULL;
+            png_filter_row (&e->filtered[y * e->stride], scratch, row, prev, length, e->heuristic);
+        }
+    }
+
+    free (scratch);
+    return NULL;
+}
+
+/* Deflate one block as a raw deflate stream. All but the last block end on a
+ * sync flush rather than a final block, and all but the first are primed with
+ * the preceding 32 KiB of data, so the blocks concatenate into one stream. */
+static void *png_deflate_worker (void *arg)
+{
+    PngEncoder *e = arg;
+    uint32_t index;
+
+    while (work_queue_take (&e->queue, &index))
+    {
+        PngBlock *block = &e->blocks[index];
+        bool last = (index == e->queue.count - 1);
+        uint8_t *input = &e->filtered[block->first_row * e->stride];
+        size_t input_size = block->rows * e->stride;
+        size_t offset = block->first_row * e->stride;
+        z_stream stream = { .zalloc = Z_NULL, .zfree = Z_NULL, .opaque = Z_NULL };
+
+        block->adler = adler32 (adler32 (0, Z_NULL, 0), input, input_size);
+
+        if (deflateInit2 (&stream, e->level, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            block->failed = true;
+            continue;
+        }
+
+        if (offset)
+        {
+            size_t dictionary_size = (offset < PNG_WINDOW_SIZE) ? offset : PNG_WINDOW_SIZE;
+            deflateSetDictionary (&stream, input - dictionary_size, dictionary_size);
+        }
+
+        /* Leave room for the empty stored block that ends a sync flush */
+        size_t bound = deflateBound (&stream, input_size) + 16;
+        block->deflated = malloc (bound);
+        if (!block->deflated)
+        {
+            deflateEnd (&stream);
+            block->failed = true;
+            continue;
+        }
+
+        stream.next_in = input;
+        stream.avail_in = input_size;
+        stream.next_out = block->deflated;
+        stream.avail_out = bound;
+
+        int ret = deflate (&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+        if (stream.avail_in != 0 || (last ? ret != Z_STREAM_END : ret != Z_OK))
+        {
+            block->failed = true;
+        }
+        block->deflated_size = bound - stream.avail_out;
+
+        /* Z_DATA_ERROR is expected here for a stream that has not been finished */
+        deflateEnd (&stream);
+    }
+
+    return NULL;
+}
+
+static void png_encoder_free (PngEncoder *e)
+{
+    for (uint32_t b = 0; e->blocks && b < e->queue.count; b++)
+    {
+        free (e->blocks[b].deflated);
+    }
+    free (e->blocks);
+    free (e->filtered);
+}
+
+/* Split the image into blocks and filter them in parallel */
+static int png_encoder_filter (PngEncoder *e, Image *i, uint8_t heuristic, int level)
+{
+    *e = (PngEncoder) { .image = i, .heuristic = heuristic, .level = level };
+    e->stride = 1 + i->width * sizeof (Pixel);
+
+    uint32_t rows_per_block = PNG_BLOCK_SIZE / e->stride;
+    if (rows_per_block == 0)
+    {
+        rows_per_block = 1;
+    }
+    e->queue.count = (i->height + rows_per_block - 1) / rows_per_block;
+
+    e->filtered = malloc (e->stride * i->height);
+    e->blocks = calloc (e->queue.count, sizeof (PngBlock));
+    if (!e->filtered || !e->blocks)
+    {
+        fprintf (stderr, "Error: Unable to allocate memory for PNG encoding.\n");
         return EXIT_FAILURE;
     }
 
-    png_ptr = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png_ptr)
+    for (uint32_t b = 0; b < e->queue.count; b++)
+    {
+        e->blocks[b].first_row = b * rows_per_block;
+        e->blocks[b].rows = (i->height - e->blocks[b].first_row < rows_per_block) ? i->height - e->blocks[b].first_row
+                                                                                   : rows_per_block;
+    }
+
+    work_queue_run (&e->queue, png_filter_worker, e);
+
+    for (uint32_t b = 0; b < e->queue.count; b++)
     {
-        fprintf (stderr, "Error: png_create_write_struct returns NULL.\n");
+        if (e->blocks[b].failed)
+        {
+            fprintf (stderr, "Error: Unable to allocate memory for PNG encoding.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Compress the image into a zlib stream, deflating blocks in parallel */
+static int png_compress_parallel (Image *i, uint8_t **idat, size_t *idat_size)
+{
+    PngEncoder e;
+    uLong adler = adler32 (0, Z_NULL, 0);
+    size_t size = 2 + 4;
+    uint8_t *data = NULL;
+
+    /* Filtering must finish before deflating, as each block is primed with the data before it */
+    if (png_encoder_filter (&e, i, PNG_HEURISTIC_MINSUM, Z_DEFAULT_COMPRESSION))
+    {
+        png_encoder_free (&e);
         return EXIT_FAILURE;
     }
+    work_queue_run (&e.queue, png_deflate_worker, &e);
 
-    info_ptr = png_create_info_struct (png_ptr);
+    /* Concatenate the blocks into a single zlib stream */
+    for (uint32_t b = 0; b < e.queue.count; b++)
+    {
+        if (e.blocks[b].failed)
+        {
+            fprintf (stderr, "Error: Unable to compress PNG data.\n");
+            png_encoder_free (&e);
+            return EXIT_FAILURE;
+        }
+        size += e.blocks[b].deflated_size;
+        adler = adler32_combine (adler, e.blocks[b].adler, e.blocks[b].rows * e.stride);
+    }
 
-    if (!info_ptr)
+    data = malloc (size);
+    if (!data)
     {
-        fprintf (stderr, "Error: png_create_info_struct returns NULL.\n");
+        fprintf (stderr, "Error: Unable to allocate memory for PNG encoding.\n");
+        png_encoder_free (&e);
         return EXIT_FAILURE;
     }
 
-    /* Set image attributes */
-    png_set_IHDR (png_ptr, info_ptr, i->width, i->height, depth,
-                  PNG_COLOR_TYPE_RGBA,
-                  PNG_INTERLACE_NONE,
-                  PNG_COMPRESSION_TYPE_DEFAULT,
-                  PNG_FILTER_TYPE_DEFAULT);
+    /* zlib header: 32 KiB window, default compression level, no preset dictionary */
+    data[0] = 0x78;
+    data[1] = 0x9c;
+    size_t offset = 2;
+    for (uint32_t b = 0; b < e.queue.count; b++)
+    {
+        memcpy (&data[offset], e.blocks[b].deflated, e.blocks[b].deflated_size);
+        offset += e.blocks[b].deflated_size;
+    }
+    png_save_uint_32 (&data[offset], adler);
+
+    png_encoder_free (&e);
 
-    /* Initialize rows of PNG */
-    row_pointers = png_malloc (png_ptr, i->height * sizeof (png_byte *));
+    *idat = data;
+    *idat_size = size;
+    return EXIT_SUCCESS;
+}
+
+/* Compress one candidate as a single zlib stream, returning NULL on failure */
+static uint8_t *png_candidate_compress (const PngCandidate *c, const uint8_t *input, size_t input_size, size_t *size)
+{
+    uint8_t *output = NULL;
 
-    for (uint32_t y = 0; y < i->height; y++)
+#ifdef USE_LIBDEFLATE
+    if (c->strategy == PNG_STRATEGY_LIBDEFLATE)
     {
-        png_byte *row = png_malloc (png_ptr, i->width * pixel_size);
-        if (!row)
+        struct libdeflate_compressor *compressor = libdeflate_alloc_compressor (c->level);
+        if (!compressor)
         {
-            fprintf (stderr, "There was a trouble.\n");
+            return NULL;
         }
-        row_pointers[y] = row;
 
-        for (uint32_t x = 0; x < i->width; x++)
+        size_t bound = libdeflate_zlib_compress_bound (compressor, input_size);
+        output = malloc (bound);
+        if (output)
         {
-            Pixel *p = pixel_get(i, x, y);
-            *row++ = p->r;
-            *row++ = p->g;
-            *row++ = p->b;
-            *row++ = p->a;
+            *size = libdeflate_zlib_compress (compressor, input, input_size, output, bound);
+            if (*size == 0)
+            {
+                free (output);
+                output = NULL;
+            }
+        }
+
+        libdeflate_free_compressor (compressor);
+        return output;
+    }
+#endif
+
+    z_stream stream = { .zalloc = Z_NULL, .zfree = Z_NULL, .opaque = Z_NULL };
+    if (deflateInit2 (&stream, c->level, Z_DEFLATED, 15, 9, c->strategy) != Z_OK)
+    {
+        return NULL;
+    }
+
+    size_t bound = deflateBound (&stream, input_size);
+    output = malloc (bound);
+    if (output)
+    {
+        stream.next_in = (uint8_t *) input;
+        stream.avail_in = input_size;
+        stream.next_out = output;
+        stream.avail_out = bound;
+
+        if (deflate (&stream, Z_FINISH) == Z_STREAM_END)
+        {
+            *size = bound - stream.avail_out;
+        }
+        else
+        {
+            free (output);
+            output = NULL;
         }
     }
 
+    deflateEnd (&stream);
+    return output;
+}
+
+/* Keep output if it is the smallest so far. Ties go to the earlier candidate,
+ * so the result does not depend on which thread finishes first. */
+static void png_search_offer (PngSearch *s, uint32_t candidate, uint8_t *output, size_t size)
+{
+    pthread_mutex_lock (&s->lock);
+    if (!s->best || size < s->best_size || (size == s->best_size && candidate < s->best_candidate))
+    {
+        free (s->best);
+        s->best = output;
+        s->best_size = size;
+        s->best_candidate = candidate;
+        output = NULL;
+    }
+    pthread_mutex_unlock (&s->lock);
+
+    free (output);
+}
+
+static void *png_search_worker (void *arg)
+{
+    PngSearch *s = arg;
+    uint32_t index;
+
+    while (work_queue_take (&s->queue, &index))
+    {
+        const PngCandidate *c = &s->candidates[index];
+        const PngEncoder *e = &s->encoders[c->heuristic];
+        size_t size = 0;
+
+        uint8_t *output = png_candidate_compress (c, e->filtered, e->stride * e->image->height, &size);
+        if (!output)
+        {
+            pthread_mutex_lock (&s->lock);
+            s->failed = true;
+            pthread_mutex_unlock (&s->lock);
+            continue;
+        }
+
+        png_search_offer (s, index, output, size);
+    }
+
+    return NULL;
+}
+
+/* Compress the image into the smallest zlib stream found by trying every
+ * filter heuristic with several deflate levels and strategies in parallel */
+static int png_compress_optimized (Image *i, uint8_t **idat, size_t *idat_size)
+{
+    static const int levels[] = { 6, 9 };
+    static const int strategies[] = { Z_DEFAULT_STRATEGY, Z_FILTERED, Z_RLE, Z_HUFFMAN_ONLY };
+    PngEncoder encoders[PNG_HEURISTIC_COUNT] = { 0 };
+    PngSearch s = { .encoders = encoders };
+    int result = EXIT_FAILURE;
+
+    uint32_t candidate_count = PNG_HEURISTIC_COUNT * (sizeof (levels) / sizeof (levels[0]))
+                                                   * (sizeof (strategies) / sizeof (strategies[0]));
+#ifdef USE_LIBDEFLATE
+    candidate_count += PNG_HEURISTIC_COUNT;
+#endif
+
+    s.candidates = calloc (candidate_count, sizeof (PngCandidate));
+    if (!s.candidates)
+    {
+        fprintf (stderr, "Error: Unable to allocate memory for PNG encoding.\n");
+        return EXIT_FAILURE;
+    }
+
+    for (uint8_t h = 0; h < PNG_HEURISTIC_COUNT; h++)
+    {
+        if (png_encoder_filter (&encoders[h], i, h, Z_DEFAULT_COMPRESSION))
+        {
+            goto done;
+        }
+
+        for (uint32_t l = 0; l < sizeof (levels) / sizeof (levels[0]); l++)
+        {
+            for (uint32_t st = 0; st < sizeof (strategies) / sizeof (strategies[0]); st++)
+            {
+                s.candidates[s.queue.count++] = (PngCandidate) { h, levels[l], strategies[st] };
+            }
+        }
+#ifdef USE_LIBDEFLATE
+        s.candidates[s.queue.count++] = (PngCandidate) { h, 12, PNG_STRATEGY_LIBDEFLATE };
+#endif
+    }
+
+    pthread_mutex_init (&s.lock, NULL);
+    work_queue_run (&s.queue, png_search_worker, &s);
+    pthread_mutex_destroy (&s.lock);
+
+    if (s.failed || !s.best)
+    {
+        fprintf (stderr, "Error: Unable to compress PNG data.\n");
+        goto done;
+    }
+
+#ifdef USE_ZOPFLI
+    /* A much slower final pass over the best filtering found */
+    {
+        const PngEncoder *e = &encoders[s.candidates[s.best_candidate].heuristic];
+        ZopfliOptions options;
+        unsigned char *output = NULL;
+        size_t size = 0;
+
+        ZopfliInitOptions (&options);
+        ZopfliCompress (&options, ZOPFLI_FORMAT_ZLIB, e->filtered, e->stride * i->height, &output, &size);
+
+        if (output && size < s.best_size)
+        {
+            free (s.best);
+            s.best = output;
+            s.best_size = size;
+        }
+        else
+        {
+            free (output);
+        }
+    }
+#endif
+
+    *idat = s.best;
+    *idat_size = s.best_size;
+    s.best = NULL;
+    result = EXIT_SUCCESS;
+
+done:
+    for (uint8_t h = 0; h < PNG_HEURISTIC_COUNT; h++)
+    {
+        png_encoder_free (&encoders[h]);
+    }
+    free (s.candidates);
+    free (s.best);
+
+    return result;
+}
+
+static int png_write_chunk_to (FILE *file, const char *type, const uint8_t *data, uint32_t length)
+{
+    uint8_t header[8];
+    uint8_t footer[4];
+    uLong crc;
+
+    png_save_uint_32 (header, length);
+    memcpy (&header[4], type, 4);
+
+    crc = crc32 (0, Z_NULL, 0);
+    crc = crc32 (crc, &header[4], 4);
+    if (length)
+    {
+        crc = crc32 (crc, data, length);
+    }
+    png_save_uint_32 (footer, crc);
+
+    if (fwrite (header, 1, sizeof (header), file) != sizeof (header) ||
+        (length && fwrite (data, 1, length, file) != length) ||
+        fwrite (footer, 1, sizeof (footer), file) != sizeof (footer))
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* When optimize is set, spend much longer searching for the smallest file */
+static int export (Image *i, const char *path, bool optimize)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    uint8_t ihdr[13];
+    uint8_t *idat = NULL;
+    size_t idat_size = 0;
+    int result = EXIT_FAILURE;
+    FILE *file = NULL;
+
+    if (optimize ? png_compress_optimized (i, &idat, &idat_size)
+                 : png_compress_parallel  (i, &idat, &idat_size))
+    {
+        return EXIT_FAILURE;
+    }
+
+    /* Image attributes */
+    png_save_uint_32 (&ihdr[0], i->width);
+    png_save_uint_32 (&ihdr[4], i->height);
+    ihdr[8]  = 8; /* Depth */
+    ihdr[9]  = PNG_COLOR_TYPE_RGBA;
+    ihdr[10] = PNG_COMPRESSION_TYPE_DEFAULT;
+    ihdr[11] = PNG_FILTER_TYPE_DEFAULT;
+    ihdr[12] = PNG_INTERLACE_NONE;
+
     /* Write to file */
-    png_init_io (png_ptr, file);
-    png_set_rows (png_ptr, info_ptr, row_pointers);
-    png_write_png (png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL);
+    file = fopen (path, "wb");
+    if (!file)
+    {
+        fprintf (stderr, "Error: Unable to open file %s for writing.\n", path);
+        goto done;
+    }
+
+    if (fwrite (signature, 1, sizeof (signature), file) != sizeof (signature) ||
+        png_write_chunk_to (file, "IHDR", ihdr, sizeof (ihdr)) ||
+        png_write_chunk_to (file, "IDAT", idat, idat_size) ||
+        png_write_chunk_to (file, "IEND", NULL, 0))
+    {
+        fprintf (stderr, "Error: Unable to write to file %s.\n", path);
+        goto done;
+    }
+
+    result = EXIT_SUCCESS;
 
+done:
     /* Tidy up */
-    for (uint32_t y = 0; y  < i->height; y++)
+    if (file && fclose (file))
     {
-        png_free (png_ptr, row_pointers[y]);
+        result = EXIT_FAILURE;
     }
-    png_free (png_ptr, row_pointers);
+    free (idat);
 
-    return EXIT_SUCCESS;
+    return result;
 }
 
 void colour_set (Image *i, uint32_t x, uint32_t y, Colour c)
@@ -195,71 +886,177 @@ void transparent_set (Image *i, uint32_t x, uint32_t y)
     p->a = 0;
 }
 
-/* To get the bottom of characters lining up, we take the y-offset to be the bottom, not the top, of the glyph */
-uint32_t draw_card_glyph (uint32_t card_col, uint32_t card_row, uint32_t x_offset, uint32_t y_baseline,
-                     FT_Face ft_face, uint32_t point, Colour colour, uint32_t c, uint32_t mirror)
+/* Render a glyph, or find it in the cache if it has been rendered before */
+const Glyph *glyph_get (FT_Face ft_face, uint32_t point, uint32_t c)
 {
     /* Possibly useful fields:
      * glyph->bitmap_left,
      * glyph->bitmap_top (distance from baseline to top of character,
      * Docs reccomend treating the bitmap as an alpha channel and blending with gamma correction */
+    for (uint32_t i = 0; i < glyph_cache_count; i++)
+    {
+        Glyph *g = &glyph_cache[i];
+        if (g->face == ft_face && g->point == point && g->c == c)
+        {
+            return g;
+        }
+    }
+
+    if (glyph_cache_count == GLYPH_CACHE_SIZE)
+    {
+        fprintf (stderr, "Error: Glyph cache is full.\n");
+        return NULL;
+    }
+
     /* Set the font size */
     if (FT_Set_Char_Size (ft_face, 0, point << 6,
                                   96, 96    /* 96 dpi */))
     {
         fprintf (stderr, "Error: Unable to set font size.\n");
-        return EXIT_FAILURE;
+        return NULL;
     }
 
     if (FT_Load_Char (ft_face, c, FT_LOAD_RENDER))
     {
         fprintf (stderr, "Error: Unable to set load glyph.\n");
-        return EXIT_FAILURE;
+        return NULL;
+    }
+
+    FT_GlyphSlot slot = ft_face->glyph;
+    Glyph *g = &glyph_cache[glyph_cache_count];
+
+    g->bitmap = malloc (slot->bitmap.width * slot->bitmap.rows + 1);
+    if (!g->bitmap)
+    {
+        fprintf (stderr, "Error: Unable to allocate memory for glyph.\n");
+        return NULL;
+    }
+
+    for (uint32_t y = 0; y < slot->bitmap.rows; y++)
+    {
+        memcpy (&g->bitmap[y * slot->bitmap.width], &slot->bitmap.buffer[y * slot->bitmap.pitch], slot->bitmap.width);
+    }
+
+    g->face = ft_face;
+    g->point = point;
+    g->c = c;
+    g->width = slot->bitmap.width;
+    g->rows = slot->bitmap.rows;
+    g->top = slot->bitmap_top;
+    g->advance = slot->advance.x >> 6; /* Advance is stored in 1/64th pixels */
+
+    glyph_cache_count++;
+    return g;
+}
+
+void glyph_cache_free (void)
+{
+    for (uint32_t i = 0; i < glyph_cache_count; i++)
+    {
+        free (glyph_cache[i].bitmap);
     }
+    glyph_cache_count = 0;
+}
 
-    if (x_offset == GLYPH_CENTRE)
+/* Replace GLYPH_CENTRE with the offset that centres the glyph on the card */
+void glyph_resolve (const Glyph *g, uint32_t *x_offset, uint32_t *y_baseline)
+{
+    if (*x_offset == GLYPH_CENTRE)
     {
-        x_offset = (CARD_WIDTH + 1 - ft_face->glyph->bitmap.width) / 2;
+        *x_offset = (CARD_WIDTH + 1 - g->width) / 2;
     }
 
-    if (y_baseline == GLYPH_CENTRE)
+    if (*y_baseline == GLYPH_CENTRE)
     {
-        /* An extra bitmap_top is added because we remove it later */
-        y_baseline = (CARD_HEIGHT - ft_face->glyph->bitmap.rows) / 2 + ft_face->glyph->bitmap_top;
+        /* An extra top is added because we remove it later */
+        *y_baseline = (CARD_HEIGHT - g->rows) / 2 + g->top;
     }
+}
 
-    for (uint32_t x = 0; x < ft_face->glyph->bitmap.width; x++)
+/* To get the bottom of characters lining up, we take the y-offset to be the bottom, not the top, of the glyph */
+void glyph_draw (uint32_t card_col, uint32_t card_row, uint32_t x_offset, uint32_t y_baseline,
+                 const Glyph *g, Colour colour, uint32_t mirror)
+{
+    for (uint32_t x = 0; x < g->width; x++)
     {
-        for (uint32_t y = 0; y < ft_face->glyph->bitmap.rows; y++)
+        for (uint32_t y = 0; y < g->rows; y++)
         {
-            uint32_t pixel_index = x + y * ft_face->glyph->bitmap.pitch;
+            uint8_t a = g->bitmap[x + y * g->width];
             /* Base glyph */
             draw_colour_over (&image, card_col * CARD_WIDTH + x + x_offset,
-                                      card_row * CARD_HEIGHT + y + y_baseline - ft_face->glyph->bitmap_top,
-                                      colour, ft_face->glyph->bitmap.buffer[pixel_index]);
+                                      card_row * CARD_HEIGHT + y + y_baseline - g->top,
+                                      colour, a);
             /* Mirrors of glpyh */
             if (mirror & MIRROR_ACROSS)
             {
                 draw_colour_over (&image, card_col * CARD_WIDTH  + (CARD_WIDTH  - (x + x_offset)),
-                                          card_row * CARD_HEIGHT + y + y_baseline - ft_face->glyph->bitmap_top,
-                                          colour, ft_face->glyph->bitmap.buffer[pixel_index]);
+                                          card_row * CARD_HEIGHT + y + y_baseline - g->top,
+                                          colour, a);
             }
             if (mirror & MIRROR_DOWN)
             {
                 draw_colour_over (&image, card_col * CARD_WIDTH + x + x_offset,
-                                          card_row * CARD_HEIGHT + (CARD_HEIGHT - (y + y_baseline - ft_face->glyph->bitmap_top)),
-                                          colour, ft_face->glyph->bitmap.buffer[pixel_index]);
+                                          card_row * CARD_HEIGHT + (CARD_HEIGHT - (y + y_baseline - g->top)),
+                                          colour, a);
             }
             if (mirror & MIRROR_DIAG)
             {
                 draw_colour_over (&image, card_col * CARD_WIDTH  + (CARD_WIDTH  - (x + x_offset)),
-                                          card_row * CARD_HEIGHT + (CARD_HEIGHT - (y + y_baseline - ft_face->glyph->bitmap_top)),
-                                          colour, ft_face->glyph->bitmap.buffer[pixel_index]);
+                                          card_row * CARD_HEIGHT + (CARD_HEIGHT - (y + y_baseline - g->top)),
+                                          colour, a);
             }
         }
     }
+}
 
-    return ft_face->glyph->advance.x >> 6; /* Advance is stored in 1/64th pixels */
+uint32_t draw_card_glyph (uint32_t card_col, uint32_t card_row, uint32_t x_offset, uint32_t y_baseline,
+                     FT_Face ft_face, uint32_t point, Colour colour, uint32_t c, uint32_t mirror)
+{
+    const Glyph *g = glyph_get (ft_face, point, c);
+    if (!g)
+    {
+        return EXIT_FAILURE;
+    }
+
+    glyph_resolve (g, &x_offset, &y_baseline);
+    glyph_draw (card_col, card_row, x_offset, y_baseline, g, colour, mirror);
+
+    return g->advance;
+}
+
+/* Load the glyphs for a layout and resolve their positions, so the result
+ * can be drawn on any number of cards without going back to FreeType */
+int draw_list_compile (DrawList *list, const PipLayout *layout, FT_Face ft_face, uint32_t c)
+{
+    list->count = layout->count;
+
+    for (uint32_t i = 0; i < layout->count; i++)
+    {
+        const Pip *pip = &layout->pips[i];
+        DrawCommand *command = &list->commands[i];
+
+        command->glyph = glyph_get (ft_face, pip->point, c);
+        if (!command->glyph)
+        {
+            return EXIT_FAILURE;
+        }
+
+        command->x = pip->x;
+        command->y = pip->y;
+        command->mirror = pip->mirror;
+        glyph_resolve (command->glyph, &command->x, &command->y);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void draw_list_draw (uint32_t card_col, uint32_t card_row, const DrawList *list, Colour colour)
+{
+    for (uint32_t i = 0; i < list->count; i++)
+    {
+        const DrawCommand *command = &list->commands[i];
+        glyph_draw (card_col, card_row, command->x, command->y, command->glyph, colour, command->mirror);
+    }
 }
 
 void draw_card_background (uint32_t card_col, uint32_t card_row)
@@ -342,28 +1139,21 @@ uint32_t string_width (char *string, uint32_t point)
 
     for (char *c = string; *c != '\0'; c++)
     {
-        if (FT_Set_Char_Size (ft_face_text, 0, point << 6,
-                                      96, 96    /* 96 dpi */))
+        const Glyph *g = glyph_get (ft_face_text, point, *c);
+        if (!g)
         {
-            fprintf (stderr, "Error: Unable to set font size.\n");
-            return EXIT_FAILURE;
-        }
-
-        if (FT_Load_Char (ft_face_text, *c, FT_LOAD_RENDER))
-        {
-            fprintf (stderr, "Error: Unable to set load glyph.\n");
             return EXIT_FAILURE;
         }
 
         if (c[1] == '\0')
         {
             /* If this is the last character, just add the width */
-            width += ft_face_text->glyph->bitmap.width;
+            width += g->width;
         }
         else
         {
             /* Otherwise add the advance */
-            width += ft_face_text->glyph->advance.x >> 6;
+            width += g->advance;
         }
     }
 
@@ -397,6 +1187,21 @@ void draw_string_outlined (uint32_t card_col, uint32_t card_row,
 
 int main (int argc, char**argv)
 {
+    bool optimize = false;
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if (!strcmp (argv[arg], "--optimize"))
+        {
+            optimize = true;
+        }
+        else
+        {
+            fprintf (stderr, "Usage: %s [--optimize]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
     /* Fixup statics */
     card_colours[0] = card_colours[1] = COLOUR_RED;
     card_colours[2] = card_colours[3] = COLOUR_BLACK;
@@ -440,12 +1245,25 @@ int main (int argc, char**argv)
         }
     }
 
+    /* Resolve the body layout of each card once per suit */
+    DrawList pip_lists[4][13];
+    for (uint32_t card_row = 0; card_row < 4; card_row++)
+    {
+        for (uint32_t card_col = 0; card_col < 13; card_col++)
+        {
+            if (draw_list_compile (&pip_lists[card_row][card_col], &pip_layouts[card_col],
+                                   ft_face_text, card_suits[card_row]))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
     /* A 13 × 4 block of playing cards */
     for (uint32_t card_col = 0; card_col < 13; card_col++)
     {
         for (uint32_t card_row= 0; card_row < 4; card_row++)
         {
-            uint32_t suit = card_suits[card_row];
             Colour colour = card_colours[card_row];
 
             draw_card_background (card_col, card_row);
@@ -456,6 +1274,7 @@ int main (int argc, char**argv)
             uint32_t escapement = 0;
 
 #if 0
+            uint32_t suit = card_suits[card_row];
             escapement = draw_card_glyph (card_col, card_row, TEXT_LEFT, TEXT_BASELINE, /* Position */
                               ft_face_text, CORNER_SUIT_POINT, colour, /* font */
                               suit, MIRROR_DIAG) + 1;
@@ -468,88 +1287,8 @@ int main (int argc, char**argv)
                                                *c, MIRROR_DIAG);
             }
 
-             /* Body of card */
-             switch (1 + card_col)
-             {
-                case 1:
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, GLYPH_CENTRE,
-                                     ft_face_text, ACE_SUIT_POINT, colour, suit, MIRROR_NONE);
-                    break;
-
-                case 2:
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN);
-                    break;
-
-                case 3:
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN);
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, GLYPH_CENTRE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_NONE);
-                    break;
-
-                case 4:
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    break;
-
-                case 5:
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, GLYPH_CENTRE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_NONE);
-                    break;
-
-                case 6:
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, GLYPH_CENTRE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_ACROSS);
-                    break;
-
-                case 7:
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, GLYPH_CENTRE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_ACROSS);
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, BODY_BASELINE + 8,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_NONE);
-                    break;
-                case 8:
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, GLYPH_CENTRE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_ACROSS);
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, BODY_BASELINE + 8,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN);
-                    break;
-                case 9:
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE + 10,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, GLYPH_CENTRE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_NONE);
-                    break;
-                case 10:
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    draw_card_glyph (card_col, card_row, BODY_LEFT, BODY_BASELINE + 10,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN | MIRROR_ACROSS | MIRROR_DIAG);
-                    draw_card_glyph (card_col, card_row, GLYPH_CENTRE, BODY_BASELINE + 5,
-                                     ft_face_text, REGULAR_SUIT_POINT, colour, suit, MIRROR_DOWN);
-                    break;
-
-                /* Picture cards just need a box */
-                case 11:
-                case 12:
-                case 13:
-                    break;
-
-                default:
-                    break;
-             }
-
+            /* Body of card */
+            draw_list_draw (card_col, card_row, &pip_lists[card_row][card_col], colour);
         }
     }
 
@@ -694,9 +1433,10 @@ int main (int argc, char**argv)
 
     }
 
-    export (&image, "cards.png");
+    int result = export (&image, "cards.png", optimize);
 
     free (image.data);
+    glyph_cache_free ();
 
-    return EXIT_SUCCESS;
+    return result;
 }